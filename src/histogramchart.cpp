@@ -0,0 +1,84 @@
+#include "tlo/histogramchart.hpp"
+#include <QPainter>
+#include <algorithm>
+
+namespace tlo {
+namespace {
+/*
+ * draws histogram as vertical bars filling rect. bins that fall in the same
+ * pixel column are merged by taking the largest count, so drawing costs one
+ * pass over the bins plus one line per column no matter how many bins there
+ * are.
+ */
+void drawHistogram(QPainter &painter, const QRect &rect,
+                   const QVector<int> &histogram, const QColor &color) {
+  painter.fillRect(rect, Qt::white);
+  painter.setPen(Qt::lightGray);
+  painter.drawRect(rect.adjusted(0, 0, -1, -1));
+  if (histogram.isEmpty() || rect.width() <= 2 || rect.height() <= 2) {
+    return;
+  }
+
+  QRect plotRect = rect.adjusted(1, 1, -1, -1);
+  int columnCount = plotRect.width();
+  QVector<int> columns(columnCount, 0);
+  for (int bin = 0; bin < histogram.size(); ++bin) {
+    int column = static_cast<int>(static_cast<qint64>(bin) * columnCount /
+                                  histogram.size());
+    columns[column] = std::max(columns[column], histogram[bin]);
+  }
+
+  int maxCount = *std::max_element(columns.cbegin(), columns.cend());
+  if (maxCount == 0) {
+    return;
+  }
+
+  QVector<QLine> lines;
+  lines.reserve(columnCount);
+  for (int column = 0; column < columnCount; ++column) {
+    int height = static_cast<int>(static_cast<qint64>(columns[column]) *
+                                  plotRect.height() / maxCount);
+    if (height > 0) {
+      int x = plotRect.left() + column;
+      lines << QLine(x, plotRect.bottom(), x, plotRect.bottom() - height + 1);
+    }
+  }
+
+  painter.setPen(color);
+  painter.drawLines(lines);
+}
+}  // namespace
+
+void HistogramChart::paintEvent(QPaintEvent *) {
+  QPainter painter(this);
+  int spacing = 4;
+  int chartHeight = (height() - 3 * spacing) / 4;
+  QRect chartRect(0, 0, width(), chartHeight);
+
+  drawHistogram(painter, chartRect, redHistogram, Qt::red);
+  chartRect.translate(0, chartHeight + spacing);
+  drawHistogram(painter, chartRect, greenHistogram, Qt::darkGreen);
+  chartRect.translate(0, chartHeight + spacing);
+  drawHistogram(painter, chartRect, blueHistogram, Qt::blue);
+  chartRect.translate(0, chartHeight + spacing);
+  drawHistogram(painter, chartRect, alphaHistogram, Qt::darkGray);
+}
+
+HistogramChart::HistogramChart(QWidget *parent) : QWidget(parent) {
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+}
+
+void HistogramChart::setHistograms(const QVector<int> &red,
+                                   const QVector<int> &green,
+                                   const QVector<int> &blue,
+                                   const QVector<int> &alpha) {
+  // the QVectors are implicitly shared so these are shallow copies
+  redHistogram = red;
+  greenHistogram = green;
+  blueHistogram = blue;
+  alphaHistogram = alpha;
+  update();
+}
+
+QSize HistogramChart::sizeHint() const { return QSize(256, 4 * 64 + 3 * 4); }
+}  // namespace tlo
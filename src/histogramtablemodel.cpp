@@ -0,0 +1,116 @@
+#include "tlo/histogramtablemodel.hpp"
+
+namespace tlo {
+namespace {
+bool binChanged(const QVector<int> &oldHistogram,
+                const QVector<int> &newHistogram, int bin) {
+  return oldHistogram[bin] != newHistogram[bin];
+}
+}  // namespace
+
+HistogramTableModel::HistogramTableModel(QObject *parent)
+    : QAbstractTableModel(parent) {}
+
+void HistogramTableModel::setHistograms(const QVector<int> &red,
+                                        const QVector<int> &green,
+                                        const QVector<int> &blue,
+                                        const QVector<int> &alpha) {
+  if (red.size() != redHistogram.size() ||
+      green.size() != greenHistogram.size() ||
+      blue.size() != blueHistogram.size() ||
+      alpha.size() != alphaHistogram.size()) {
+    beginResetModel();
+    redHistogram = red;
+    greenHistogram = green;
+    blueHistogram = blue;
+    alphaHistogram = alpha;
+    endResetModel();
+    return;
+  }
+
+  // only report the span of rows whose counts actually changed
+  int firstChangedRow = -1;
+  int lastChangedRow = -1;
+  for (int bin = 0; bin < red.size(); ++bin) {
+    if (binChanged(redHistogram, red, bin) ||
+        binChanged(greenHistogram, green, bin) ||
+        binChanged(blueHistogram, blue, bin) ||
+        binChanged(alphaHistogram, alpha, bin)) {
+      if (firstChangedRow == -1) {
+        firstChangedRow = bin;
+      }
+      lastChangedRow = bin;
+    }
+  }
+
+  redHistogram = red;
+  greenHistogram = green;
+  blueHistogram = blue;
+  alphaHistogram = alpha;
+  if (firstChangedRow != -1) {
+    emit dataChanged(index(firstChangedRow, RED_COLUMN),
+                     index(lastChangedRow, ALPHA_COLUMN));
+  }
+}
+
+int HistogramTableModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : redHistogram.size();
+}
+
+int HistogramTableModel::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant HistogramTableModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= rowCount()) {
+    return QVariant();
+  }
+
+  if (role == Qt::TextAlignmentRole) {
+    return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+  }
+
+  if (role != Qt::DisplayRole) {
+    return QVariant();
+  }
+
+  int bin = index.row();
+  switch (index.column()) {
+    case VALUE_COLUMN:
+      return bin;
+    case RED_COLUMN:
+      return redHistogram[bin];
+    case GREEN_COLUMN:
+      return greenHistogram[bin];
+    case BLUE_COLUMN:
+      return blueHistogram[bin];
+    case ALPHA_COLUMN:
+      return alphaHistogram[bin];
+    default:
+      return QVariant();
+  }
+}
+
+QVariant HistogramTableModel::headerData(int section,
+                                         Qt::Orientation orientation,
+                                         int role) const {
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+    return QVariant();
+  }
+
+  switch (section) {
+    case VALUE_COLUMN:
+      return tr("Value");
+    case RED_COLUMN:
+      return tr("Red");
+    case GREEN_COLUMN:
+      return tr("Green");
+    case BLUE_COLUMN:
+      return tr("Blue");
+    case ALPHA_COLUMN:
+      return tr("Alpha");
+    default:
+      return QVariant();
+  }
+}
+}  // namespace tlo
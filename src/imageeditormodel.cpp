@@ -1,4 +1,6 @@
 #include "tlo/imageeditormodel.hpp"
+#include <QThreadPool>
+#include <QtConcurrent>
 #include <cmath>
 
 namespace tlo {
@@ -7,7 +9,19 @@ void ImageEditorModel::emitImageModified() {
   emit imageModified();
 }
 
+void ImageEditorModel::logOperation(const QString &name,
+                                    const QVariantList &arguments) {
+  operations_ << ImageOperation{name, arguments};
+}
+
+void ImageEditorModel::loadOriginalImageIfNeeded() const {
+  if (originalImage_.isNull() && !filePath_.isEmpty()) {
+    originalImage_.load(filePath_);
+  }
+}
+
 void ImageEditorModel::copyConvertedOriginalToImage() {
+  operations_.clear();
   if (originalImage_.hasAlphaChannel()) {
     image_ = originalImage_.convertToFormat(QImage::Format_ARGB32);
   } else {
@@ -16,7 +30,15 @@ void ImageEditorModel::copyConvertedOriginalToImage() {
   emitImageModified();
 }
 
-ImageEditorModel::ImageEditorModel(QObject *parent) : QObject(parent) {}
+void ImageEditorModel::emitSaveFinished() {
+  emit saveFinished(saveWatcher.result());
+}
+
+ImageEditorModel::ImageEditorModel(QObject *parent) : QObject(parent) {
+  connect(&saveWatcher, SIGNAL(finished()), this, SLOT(emitSaveFinished()));
+}
+
+ImageEditorModel::~ImageEditorModel() { saveWatcher.waitForFinished(); }
 
 bool ImageEditorModel::load(const QString &filePath) {
   bool loaded = originalImage_.load(filePath);
@@ -29,15 +51,108 @@ bool ImageEditorModel::load(const QString &filePath) {
   return true;
 }
 
+bool ImageEditorModel::loadSession(const QString &filePath) {
+  ImageSession session;
+  bool loaded = readImageSession(filePath, session);
+  if (!loaded) {
+    return false;
+  }
+
+  // the source image is only decoded again if the image is reverted to it
+  filePath_ = session.sourceFilePath;
+  originalImage_ = QImage();
+  image_ = session.image;
+  operations_ = session.operations;
+
+  /*
+   * the cached information is restored before imageModified is emitted so
+   * that listeners asking for it don't recompute it
+   */
+  revision++;
+  if (session.hasImageInformation) {
+    redHistogram_ = session.redHistogram;
+    greenHistogram_ = session.greenHistogram;
+    blueHistogram_ = session.blueHistogram;
+    alphaHistogram_ = session.alphaHistogram;
+    redEntropy_ = session.redEntropy;
+    greenEntropy_ = session.greenEntropy;
+    blueEntropy_ = session.blueEntropy;
+    alphaEntropy_ = session.alphaEntropy;
+    computedInfoRevision = revision;
+  }
+  emit imageModified();
+  return true;
+}
+
+bool ImageEditorModel::saveSession(const QString &filePath) const {
+  ImageSession session;
+  session.sourceFilePath = filePath_;
+  session.operations = operations_;
+  session.image = image_;
+  session.hasImageInformation = computedInfoRevision == revision;
+  if (session.hasImageInformation) {
+    session.redHistogram = redHistogram_;
+    session.greenHistogram = greenHistogram_;
+    session.blueHistogram = blueHistogram_;
+    session.alphaHistogram = alphaHistogram_;
+    session.redEntropy = redEntropy_;
+    session.greenEntropy = greenEntropy_;
+    session.blueEntropy = blueEntropy_;
+    session.alphaEntropy = alphaEntropy_;
+  }
+
+  return writeImageSession(session, filePath);
+}
+
 bool ImageEditorModel::save(const QString &filePath) const {
-  return image_.save(filePath);
+  return writeImage(image_, filePath, ImageWriteOptions());
 }
 
+bool ImageEditorModel::saveAsync(const QString &filePath,
+                                 const ImageWriteOptions &options) {
+  if (isSaving()) {
+    return false;
+  }
+
+  /*
+   * image is a shallow copy of image_. the transforms detach image_ before
+   * writing to it, so the image can keep being edited while the copy is saved
+   */
+  QImage image = image_;
+  saveWatcher.setFuture(QtConcurrent::run([this, image, filePath, options]() {
+    /*
+     * this thread only waits for and writes out the chunks that are
+     * compressed on the global thread pool, so give its slot back to the pool
+     */
+    QThreadPool::globalInstance()->releaseThread();
+    bool saved = writeImage(image, filePath, options, [this](int percent) {
+      emit saveProgressChanged(percent);
+    });
+    QThreadPool::globalInstance()->reserveThread();
+    return saved;
+  }));
+  return true;
+}
+
+bool ImageEditorModel::isSaving() const { return saveWatcher.isRunning(); }
+
 const QString &ImageEditorModel::filePath() const { return filePath_; }
-const QImage &ImageEditorModel::originalImage() const { return originalImage_; }
+
+const QImage &ImageEditorModel::originalImage() const {
+  loadOriginalImageIfNeeded();
+  return originalImage_;
+}
+
 const QImage &ImageEditorModel::image() const { return image_; }
 
+const QVector<ImageOperation> &ImageEditorModel::operations() const {
+  return operations_;
+}
+
 namespace {
+// one bin per value of an 8-bit channel
+const int HISTOGRAM_BIN_COUNT = 256;
+
 int min(int a, int b) { return b < a ? b : a; }
 int min(int a, int b, int c) { return min(min(a, b), c); }
 int max(int a, int b) { return b > a ? b : a; }
@@ -150,25 +265,36 @@ struct ReduceColorDepth {
 };
 }  // namespace
 
-void ImageEditorModel::revertToOriginal() { copyConvertedOriginalToImage(); }
+void ImageEditorModel::revertToOriginal() {
+  loadOriginalImageIfNeeded();
+  if (originalImage_.isNull()) {
+    return;
+  }
+
+  copyConvertedOriginalToImage();
+}
 
 void ImageEditorModel::convertToGrayscaleLightness() {
   recolor(image_, grayscaleLightness);
+  logOperation("convertToGrayscaleLightness");
   emitImageModified();
 }
 
 void ImageEditorModel::convertToGrayscaleAverage() {
   recolor(image_, grayscaleAverage);
+  logOperation("convertToGrayscaleAverage");
   emitImageModified();
 }
 
 void ImageEditorModel::convertToGrayscaleLuminosity() {
   recolor(image_, grayscaleLuminosity);
+  logOperation("convertToGrayscaleLuminosity");
   emitImageModified();
 }
 
 void ImageEditorModel::gammaCorrect(double gamma) {
   recolor(image_, GammaCorrect{gamma});
+  logOperation("gammaCorrect", {gamma});
   emitImageModified();
 }
 
@@ -176,6 +302,8 @@ void ImageEditorModel::reduceColorDepthMiddle(int redDepth, int greenDepth,
                                               int blueDepth, int alphaDepth) {
   recolor(image_, ReduceColorDepth<Middle>{redDepth, greenDepth, blueDepth,
                                            alphaDepth});
+  logOperation("reduceColorDepthMiddle",
+               {redDepth, greenDepth, blueDepth, alphaDepth});
   emitImageModified();
 }
 
@@ -183,6 +311,8 @@ void ImageEditorModel::reduceColorDepthLowest(int redDepth, int greenDepth,
                                               int blueDepth, int alphaDepth) {
   recolor(image_, ReduceColorDepth<Lowest>{redDepth, greenDepth, blueDepth,
                                            alphaDepth});
+  logOperation("reduceColorDepthLowest",
+               {redDepth, greenDepth, blueDepth, alphaDepth});
   emitImageModified();
 }
 
@@ -190,6 +320,8 @@ void ImageEditorModel::reduceColorDepthHighest(int redDepth, int greenDepth,
                                                int blueDepth, int alphaDepth) {
   recolor(image_, ReduceColorDepth<Highest>{redDepth, greenDepth, blueDepth,
                                             alphaDepth});
+  logOperation("reduceColorDepthHighest",
+               {redDepth, greenDepth, blueDepth, alphaDepth});
   emitImageModified();
 }
 
@@ -197,57 +329,67 @@ void ImageEditorModel::reduceColorDepthDynamic(int redDepth, int greenDepth,
                                                int blueDepth, int alphaDepth) {
   recolor(image_, ReduceColorDepth<Dynamic>{redDepth, greenDepth, blueDepth,
                                             alphaDepth});
+  logOperation("reduceColorDepthDynamic",
+               {redDepth, greenDepth, blueDepth, alphaDepth});
   emitImageModified();
 }
 
+bool ImageEditorModel::resize(int width, int height, ResizeFilter filter) {
+  QImage resized = resizeImage(image_, width, height, filter);
+  if (resized.isNull()) {
+    return false;
+  }
+
+  image_ = resized;
+  logOperation("resize", {width, height, static_cast<int>(filter)});
+  emitImageModified();
+  return true;
+}
+
 void ImageEditorModel::computeImageInformation() {
   if (computedInfoRevision == revision) {
     return;
   }
 
-  redHistogram_.clear();
-  greenHistogram_.clear();
-  blueHistogram_.clear();
-  alphaHistogram_.clear();
-  QRgb *pixels = reinterpret_cast<QRgb *>(image_.bits());
+  redHistogram_.fill(0, HISTOGRAM_BIN_COUNT);
+  greenHistogram_.fill(0, HISTOGRAM_BIN_COUNT);
+  blueHistogram_.fill(0, HISTOGRAM_BIN_COUNT);
+  alphaHistogram_.fill(0, HISTOGRAM_BIN_COUNT);
+  int *redBins = redHistogram_.data();
+  int *greenBins = greenHistogram_.data();
+  int *blueBins = blueHistogram_.data();
+  int *alphaBins = alphaHistogram_.data();
+  const QRgb *pixels = reinterpret_cast<const QRgb *>(image_.constBits());
   int pixelCount = image_.byteCount() / static_cast<int>(sizeof(QRgb));
   for (int i = 0; i < pixelCount; ++i) {
-    int red = qRed(pixels[i]);
-    int green = qGreen(pixels[i]);
-    int blue = qBlue(pixels[i]);
-    int alpha = qAlpha(pixels[i]);
-    redHistogram_[red]++;
-    greenHistogram_[green]++;
-    blueHistogram_[blue]++;
-    alphaHistogram_[alpha]++;
+    redBins[qRed(pixels[i])]++;
+    greenBins[qGreen(pixels[i])]++;
+    blueBins[qBlue(pixels[i])]++;
+    alphaBins[qAlpha(pixels[i])]++;
   }
 
   redEntropy_ = 0;
   greenEntropy_ = 0;
   blueEntropy_ = 0;
   alphaEntropy_ = 0;
-  for (int i = 0; i < 256; ++i) {
-    if (redHistogram_.contains(i)) {
-      double redProbability =
-          static_cast<double>(redHistogram_[i]) / pixelCount;
+  for (int i = 0; i < HISTOGRAM_BIN_COUNT; ++i) {
+    if (redBins[i] > 0) {
+      double redProbability = static_cast<double>(redBins[i]) / pixelCount;
       redEntropy_ += -redProbability * std::log2(redProbability);
     }
 
-    if (greenHistogram_.contains(i)) {
-      double greenProbability =
-          static_cast<double>(greenHistogram_[i]) / pixelCount;
+    if (greenBins[i] > 0) {
+      double greenProbability = static_cast<double>(greenBins[i]) / pixelCount;
       greenEntropy_ += -greenProbability * std::log2(greenProbability);
     }
 
-    if (blueHistogram_.contains(i)) {
-      double blueProbability =
-          static_cast<double>(blueHistogram_[i]) / pixelCount;
+    if (blueBins[i] > 0) {
+      double blueProbability = static_cast<double>(blueBins[i]) / pixelCount;
       blueEntropy_ += -blueProbability * std::log2(blueProbability);
     }
 
-    if (alphaHistogram_.contains(i)) {
-      double alphaProbability =
-          static_cast<double>(alphaHistogram_[i]) / pixelCount;
+    if (alphaBins[i] > 0) {
+      double alphaProbability = static_cast<double>(alphaBins[i]) / pixelCount;
       alphaEntropy_ += -alphaProbability * std::log2(alphaProbability);
     }
   }
@@ -255,22 +397,22 @@ void ImageEditorModel::computeImageInformation() {
   computedInfoRevision = revision;
 }
 
-const QMap<int, int> &ImageEditorModel::redHistogram() {
+const QVector<int> &ImageEditorModel::redHistogram() {
   computeImageInformation();
   return redHistogram_;
 }
 
-const QMap<int, int> &ImageEditorModel::greenHistogram() {
+const QVector<int> &ImageEditorModel::greenHistogram() {
   computeImageInformation();
   return greenHistogram_;
 }
 
-const QMap<int, int> &ImageEditorModel::blueHistogram() {
+const QVector<int> &ImageEditorModel::blueHistogram() {
   computeImageInformation();
   return blueHistogram_;
 }
 
-const QMap<int, int> &ImageEditorModel::alphaHistogram() {
+const QVector<int> &ImageEditorModel::alphaHistogram() {
   computeImageInformation();
   return alphaHistogram_;
 }
@@ -1,4 +1,5 @@
 #include "tlo/imageeditorview.hpp"
+#include <QComboBox>
 #include <QDialogButtonBox>
 #include <QFileDialog>
 #include <QFormLayout>
@@ -7,9 +8,8 @@
 #include <QLabel>
 #include <QMessageBox>
 #include <QSpinBox>
-#include <QTextEdit>
-#include <QTextStream>
 #include <cfloat>
+#include <climits>
 #include "tlo/ui_imageeditorview.h"
 
 namespace tlo {
@@ -54,17 +54,132 @@ void ImageEditorView::on_actionOpen_triggered() {
   }
 }
 
+namespace {
+QSpinBox *makeSpinBox(QWidget *parent, int defaultValue, int minValue,
+                      int maxValue) {
+  QSpinBox *spinBox = new QSpinBox(parent);
+  spinBox->setMinimum(minValue);
+  spinBox->setMaximum(maxValue);
+  spinBox->setValue(defaultValue);
+  return spinBox;
+}
+
+QSpinBox *makeOptionalSpinBox(QWidget *parent, int minValue, int maxValue,
+                              const QString &unsetText) {
+  // the minimum value means the option is unset and is shown as unsetText
+  QSpinBox *spinBox = makeSpinBox(parent, minValue, minValue, maxValue);
+  spinBox->setSpecialValueText(unsetText);
+  return spinBox;
+}
+
+ImageWriteOptions getImageWriteOptions(QWidget *parent, bool &ok) {
+  ok = false;
+
+  QDialog dialog(parent);
+  dialog.setWindowTitle(QObject::tr("Save Options"));
+
+  QFormLayout formLayout(&dialog);
+  QSpinBox *qualitySpinBox =
+      makeOptionalSpinBox(&dialog, -1, 100, QObject::tr("Default"));
+  formLayout.addRow(QObject::tr("Quality"), qualitySpinBox);
+  QSpinBox *compressionLevelSpinBox =
+      makeOptionalSpinBox(&dialog, -1, 9, QObject::tr("Default"));
+  formLayout.addRow(QObject::tr("Compression Level"), compressionLevelSpinBox);
+  QSpinBox *rowsPerChunkSpinBox =
+      makeOptionalSpinBox(&dialog, 0, INT_MAX, QObject::tr("Automatic"));
+  formLayout.addRow(QObject::tr("Rows per Chunk/Strip"), rowsPerChunkSpinBox);
+
+  QDialogButtonBox dialogButtonBox(
+      QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dialog);
+  formLayout.addRow(&dialogButtonBox);
+  QObject::connect(&dialogButtonBox, SIGNAL(accepted()), &dialog,
+                   SLOT(accept()));
+  QObject::connect(&dialogButtonBox, SIGNAL(rejected()), &dialog,
+                   SLOT(reject()));
+
+  int result = dialog.exec();
+  if (result != QDialog::Accepted) {
+    return ImageWriteOptions();
+  }
+
+  ImageWriteOptions options;
+  options.quality = qualitySpinBox->value();
+  options.compressionLevel = compressionLevelSpinBox->value();
+  options.rowsPerChunk = rowsPerChunkSpinBox->value();
+
+  ok = true;
+  return options;
+}
+}  // namespace
+
+void ImageEditorView::updateSaveProgress(int percent) {
+  saveProgressBar->setValue(percent);
+}
+
+void ImageEditorView::finishSaving(bool saved) {
+  saveProgressBar->hide();
+  ui->actionSave_As->setEnabled(true);
+  if (!saved) {
+    QMessageBox::critical(this, tr("Error"), tr("Could not save file"));
+    return;
+  }
+
+  ui->statusBar->showMessage(tr("Saved"), 2000);
+}
+
 void ImageEditorView::on_actionSave_As_triggered() {
   QString filePath = QFileDialog::getSaveFileName(this);
   if (filePath.isEmpty()) {
     return;
   }
 
-  bool saved = imageEditorModel->save(filePath);
-  if (!saved) {
+  bool ok;
+  ImageWriteOptions options = getImageWriteOptions(this, ok);
+  if (!ok) {
+    return;
+  }
+
+  bool started = imageEditorModel->saveAsync(filePath, options);
+  if (!started) {
     QMessageBox::critical(this, tr("Error"), tr("Could not save file"));
     return;
   }
+
+  ui->actionSave_As->setEnabled(false);
+  saveProgressBar->setValue(0);
+  saveProgressBar->show();
+}
+
+namespace {
+const char SESSION_FILTER[] = "tloimageeditor Sessions (*.tlosession)";
+}  // namespace
+
+void ImageEditorView::on_actionOpen_Session_triggered() {
+  QString filePath = QFileDialog::getOpenFileName(this, QString(), QString(),
+                                                  tr(SESSION_FILTER));
+  if (filePath.isEmpty()) {
+    return;
+  }
+
+  bool loaded = imageEditorModel->loadSession(filePath);
+  if (!loaded) {
+    QMessageBox::critical(this, tr("Error"), tr("Could not open session"));
+    return;
+  }
+}
+
+void ImageEditorView::on_actionSave_Session_As_triggered() {
+  QString filePath = QFileDialog::getSaveFileName(this, QString(), QString(),
+                                                  tr(SESSION_FILTER));
+  if (filePath.isEmpty()) {
+    return;
+  }
+
+  bool saved = imageEditorModel->saveSession(filePath);
+  if (!saved) {
+    QMessageBox::critical(this, tr("Error"), tr("Could not save session"));
+    return;
+  }
 }
 
 void ImageEditorView::on_actionQuit_triggered() { QCoreApplication::quit(); }
@@ -105,15 +220,6 @@ void ImageEditorView::on_actionGamma_Correct_triggered() {
 }
 
 namespace {
-QSpinBox *makeSpinBox(QWidget *parent, int defaultValue, int minValue,
-                      int maxValue) {
-  QSpinBox *spinBox = new QSpinBox(parent);
-  spinBox->setValue(defaultValue);
-  spinBox->setMinimum(minValue);
-  spinBox->setMaximum(maxValue);
-  return spinBox;
-}
-
 const int RED_INDEX = 0;
 const int GREEN_INDEX = 1;
 const int BLUE_INDEX = 2;
@@ -239,63 +345,57 @@ void tlo::ImageEditorView::on_actionReduce_Color_Depth_Dynamic_triggered() {
                                             alphaDepth);
 }
 
-void tlo::ImageEditorView::on_actionCompute_Image_Information_triggered() {
-  QString text;
-  QTextStream textStream(&text);
-
-  textStream << "Red Channel:" << endl;
-  textStream << "  Histogram: " << endl;
-  const auto &redHistogram = imageEditorModel->redHistogram();
-  for (auto i = redHistogram.cbegin(); i != redHistogram.cend(); ++i) {
-    textStream << "    " << i.key() << ": " << i.value() << endl;
-  }
-  textStream << "  Entropy: " << imageEditorModel->redEntropy() << endl;
-  textStream << endl;
-
-  textStream << "Green Channel:" << endl;
-  textStream << "  Histogram: " << endl;
-  const auto &greenHistogram = imageEditorModel->greenHistogram();
-  for (auto i = greenHistogram.cbegin(); i != greenHistogram.cend(); ++i) {
-    textStream << "    " << i.key() << ": " << i.value() << endl;
-  }
-  textStream << "  Entropy: " << imageEditorModel->greenEntropy() << endl;
-  textStream << endl;
-
-  textStream << "Blue Channel:" << endl;
-  textStream << "  Histogram: " << endl;
-  const auto &blueHistogram = imageEditorModel->blueHistogram();
-  for (auto i = blueHistogram.cbegin(); i != blueHistogram.cend(); ++i) {
-    textStream << "    " << i.key() << ": " << i.value() << endl;
-  }
-  textStream << "  Entropy: " << imageEditorModel->blueEntropy() << endl;
-  textStream << endl;
-
-  textStream << "Alpha Channel:" << endl;
-  textStream << "  Histogram: " << endl;
-  const auto &alphaHistogram = imageEditorModel->alphaHistogram();
-  for (auto i = alphaHistogram.cbegin(); i != alphaHistogram.cend(); ++i) {
-    textStream << "    " << i.key() << ": " << i.value() << endl;
-  }
-  textStream << "  Entropy: " << imageEditorModel->alphaEntropy() << endl;
-  textStream << endl;
-
+void tlo::ImageEditorView::on_actionResize_triggered() {
   QDialog dialog(this);
-  dialog.setWindowTitle(tr("Image Information"));
+  dialog.setWindowTitle(tr("Resize"));
 
-  QTextEdit textEdit;
-  textEdit.setText(text);
-  textEdit.setReadOnly(true);
-
-  QVBoxLayout vBoxLayout(&dialog);
-  vBoxLayout.addWidget(&textEdit);
+  QFormLayout formLayout(&dialog);
+  int maxSize = 65535;
+  QSpinBox *widthSpinBox = makeSpinBox(&dialog, 1, 1, maxSize);
+  widthSpinBox->setValue(imageEditorModel->image().width());
+  formLayout.addRow(tr("Width"), widthSpinBox);
+  QSpinBox *heightSpinBox = makeSpinBox(&dialog, 1, 1, maxSize);
+  heightSpinBox->setValue(imageEditorModel->image().height());
+  formLayout.addRow(tr("Height"), heightSpinBox);
+
+  // formLayout takes ownership of filterComboBox
+  auto *filterComboBox = new QComboBox(&dialog);
+  filterComboBox->addItem(tr("Box"), static_cast<int>(ResizeFilter::BOX));
+  filterComboBox->addItem(tr("Bilinear"),
+                          static_cast<int>(ResizeFilter::BILINEAR));
+  filterComboBox->addItem(tr("Bicubic"),
+                          static_cast<int>(ResizeFilter::BICUBIC));
+  filterComboBox->addItem(tr("Lanczos"),
+                          static_cast<int>(ResizeFilter::LANCZOS));
+  filterComboBox->setCurrentIndex(filterComboBox->count() - 1);
+  formLayout.addRow(tr("Filter"), filterComboBox);
 
-  QDialogButtonBox dialogButtonBox(QDialogButtonBox::Ok, Qt::Horizontal,
-                                   &dialog);
-  vBoxLayout.addWidget(&dialogButtonBox);
+  QDialogButtonBox dialogButtonBox(
+      QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dialog);
+  formLayout.addRow(&dialogButtonBox);
   QObject::connect(&dialogButtonBox, SIGNAL(accepted()), &dialog,
                    SLOT(accept()));
+  QObject::connect(&dialogButtonBox, SIGNAL(rejected()), &dialog,
+                   SLOT(reject()));
 
-  dialog.exec();
+  int result = dialog.exec();
+  if (result != QDialog::Accepted) {
+    return;
+  }
+
+  auto filter =
+      static_cast<ResizeFilter>(filterComboBox->currentData().toInt());
+  bool resized = imageEditorModel->resize(widthSpinBox->value(),
+                                          heightSpinBox->value(), filter);
+  if (!resized) {
+    QMessageBox::critical(this, tr("Error"), tr("Could not resize image"));
+    return;
+  }
+}
+
+void tlo::ImageEditorView::on_actionCompute_Image_Information_triggered() {
+  imageInformationPanel->show();
+  imageInformationPanel->raise();
 }
 
 ImageEditorView::ImageEditorView(ImageEditorModel &model, QWidget *parent)
@@ -305,8 +405,23 @@ ImageEditorView::ImageEditorView(ImageEditorModel &model, QWidget *parent)
   ui->setupUi(this);
   ui->graphicsView->setScene(&graphicsScene);
 
+  // statusBar takes ownership of saveProgressBar
+  saveProgressBar = new QProgressBar;
+  saveProgressBar->setRange(0, 100);
+  saveProgressBar->hide();
+  ui->statusBar->addPermanentWidget(saveProgressBar);
+
+  // the main window takes ownership of imageInformationPanel
+  imageInformationPanel = new ImageInformationPanel(model, this);
+  addDockWidget(Qt::RightDockWidgetArea, imageInformationPanel);
+  imageInformationPanel->hide();
+
   connect(imageEditorModel, SIGNAL(imageModified()), this,
           SLOT(updateGraphicsScene()));
+  connect(imageEditorModel, SIGNAL(saveProgressChanged(int)), this,
+          SLOT(updateSaveProgress(int)));
+  connect(imageEditorModel, SIGNAL(saveFinished(bool)), this,
+          SLOT(finishSaving(bool)));
 }
 
 ImageEditorView::~ImageEditorView() { delete ui; }
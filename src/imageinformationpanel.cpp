@@ -0,0 +1,74 @@
+#include "tlo/imageinformationpanel.hpp"
+#include <QHeaderView>
+#include <QSplitter>
+#include <QTableView>
+#include <QVBoxLayout>
+
+namespace tlo {
+void ImageInformationPanel::markOutOfDate() {
+  outOfDate = true;
+  updateIfVisible();
+}
+
+void ImageInformationPanel::updateIfVisible() {
+  if (outOfDate && isVisible()) {
+    updateInformation();
+  }
+}
+
+ImageInformationPanel::ImageInformationPanel(ImageEditorModel &model,
+                                             QWidget *parent)
+    : QDockWidget(tr("Image Information"), parent),
+      imageEditorModel(&model) {
+  setObjectName("imageInformationPanel");
+
+  // the objects below are owned by their parents
+  histogramTableModel = new HistogramTableModel(this);
+  auto *contents = new QWidget(this);
+  auto *vBoxLayout = new QVBoxLayout(contents);
+
+  entropyLabel = new QLabel(contents);
+  entropyLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+  vBoxLayout->addWidget(entropyLabel);
+
+  auto *splitter = new QSplitter(Qt::Vertical, contents);
+  histogramChart = new HistogramChart(splitter);
+  auto *tableView = new QTableView(splitter);
+  tableView->setModel(histogramTableModel);
+  tableView->verticalHeader()->hide();
+  /*
+   * with a fixed row height, the view can work out which rows are visible
+   * without asking the model for the size of every row
+   */
+  tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+  splitter->addWidget(histogramChart);
+  splitter->addWidget(tableView);
+  vBoxLayout->addWidget(splitter);
+
+  setWidget(contents);
+
+  connect(imageEditorModel, SIGNAL(imageModified()), this,
+          SLOT(markOutOfDate()));
+  connect(this, SIGNAL(visibilityChanged(bool)), this,
+          SLOT(updateIfVisible()));
+}
+
+void ImageInformationPanel::updateInformation() {
+  const auto &redHistogram = imageEditorModel->redHistogram();
+  const auto &greenHistogram = imageEditorModel->greenHistogram();
+  const auto &blueHistogram = imageEditorModel->blueHistogram();
+  const auto &alphaHistogram = imageEditorModel->alphaHistogram();
+  histogramChart->setHistograms(redHistogram, greenHistogram, blueHistogram,
+                                alphaHistogram);
+  histogramTableModel->setHistograms(redHistogram, greenHistogram,
+                                    blueHistogram, alphaHistogram);
+
+  entropyLabel->setText(tr("Entropy: Red %1, Green %2, Blue %3, Alpha %4")
+                            .arg(imageEditorModel->redEntropy())
+                            .arg(imageEditorModel->greenEntropy())
+                            .arg(imageEditorModel->blueEntropy())
+                            .arg(imageEditorModel->alphaEntropy()));
+  outOfDate = false;
+}
+}  // namespace tlo
@@ -0,0 +1,313 @@
+#include "tlo/imageresizer.hpp"
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace tlo {
+namespace {
+const double PI = 3.14159265358979323846;
+
+// rows resampled together so that transposed writes fill whole cache lines
+const int ROW_BLOCK_SIZE = 16;
+
+/*
+ * weights are fixed point numbers with this many fractional bits. it leaves
+ * room for the lanczos lobes in 16 bits and for sums of 8-bit pixels in 32
+ */
+const int WEIGHT_PRECISION_BITS = 14;
+
+struct Filter {
+  double support;
+  double (*weight)(double x);
+};
+
+/*
+ * the interval is closed on the right so that an output pixel whose center
+ * lands exactly between two input pixels still covers one of them
+ */
+double boxWeight(double x) { return x > -0.5 && x <= 0.5 ? 1.0 : 0.0; }
+
+double bilinearWeight(double x) {
+  x = std::abs(x);
+  return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+double bicubicWeight(double x) {
+  // keys cubic convolution with a = -0.5
+  const double a = -0.5;
+  x = std::abs(x);
+  if (x < 1.0) {
+    return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+  }
+  if (x < 2.0) {
+    return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+  }
+  return 0.0;
+}
+
+double sinc(double x) {
+  if (std::abs(x) < 1e-9) {
+    return 1.0;
+  }
+  x *= PI;
+  return std::sin(x) / x;
+}
+
+double lanczosWeight(double x) {
+  return x > -3.0 && x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+}
+
+Filter getFilter(ResizeFilter filter) {
+  switch (filter) {
+    case ResizeFilter::BOX:
+      return Filter{0.5, boxWeight};
+    case ResizeFilter::BILINEAR:
+      return Filter{1.0, bilinearWeight};
+    case ResizeFilter::BICUBIC:
+      return Filter{2.0, bicubicWeight};
+    case ResizeFilter::LANCZOS:
+      return Filter{3.0, lanczosWeight};
+  }
+  return Filter{3.0, lanczosWeight};
+}
+
+/*
+ * the weights of every output pixel along one axis. output pixel i is the sum
+ * of input pixels starts[i] to starts[i] + counts[i] - 1 multiplied by
+ * weights[i * taps] onwards.
+ */
+struct AxisWeights {
+  int taps = 0;
+  QVector<int> starts;
+  QVector<int> counts;
+  QVector<qint16> weights;
+};
+
+/*
+ * returns weights with no taps if the table would not fit in a QVector, which
+ * qt5 limits to INT_MAX bytes
+ */
+AxisWeights computeAxisWeights(int inputSize, int outputSize,
+                               const Filter &filter) {
+  double scale = static_cast<double>(inputSize) / outputSize;
+  // when downscaling, the filter is stretched so every input pixel counts
+  double filterScale = std::max(scale, 1.0);
+  double support = filter.support * filterScale;
+
+  AxisWeights axisWeights;
+  int taps = static_cast<int>(std::ceil(support)) * 2 + 1;
+  qint64 tableBytes = static_cast<qint64>(outputSize) * taps *
+                     static_cast<qint64>(sizeof(qint16));
+  if (tableBytes > INT_MAX) {
+    return axisWeights;
+  }
+
+  axisWeights.taps = taps;
+  axisWeights.starts.resize(outputSize);
+  axisWeights.counts.resize(outputSize);
+  axisWeights.weights.fill(0, outputSize * axisWeights.taps);
+  QVector<double> exactWeights(axisWeights.taps);
+
+  for (int i = 0; i < outputSize; ++i) {
+    double center = (i + 0.5) * scale;
+    int start = std::max(static_cast<int>(center - support + 0.5), 0);
+    int end = std::min(static_cast<int>(center + support + 0.5), inputSize);
+    int count = std::min(end - start, axisWeights.taps);
+
+    double total = 0.0;
+    for (int j = 0; j < count; ++j) {
+      exactWeights[j] =
+          filter.weight((start + j - center + 0.5) / filterScale);
+      total += exactWeights[j];
+    }
+
+    /*
+     * each weight is the difference between consecutive rounded running
+     * sums. this spreads the rounding error across the taps so that the
+     * weights always add up to exactly one, even when every single weight is
+     * too small to be represented on its own
+     */
+    qint16 *weights = axisWeights.weights.data() + i * axisWeights.taps;
+    double runningTotal = 0.0;
+    long roundedRunningTotal = 0;
+    for (int j = 0; j < count && total > 0.0; ++j) {
+      runningTotal += exactWeights[j] / total;
+      long rounded = std::lround(runningTotal * (1 << WEIGHT_PRECISION_BITS));
+      weights[j] = static_cast<qint16>(rounded - roundedRunningTotal);
+      roundedRunningTotal = rounded;
+    }
+
+    axisWeights.starts[i] = start;
+    axisWeights.counts[i] = count;
+  }
+
+  return axisWeights;
+}
+
+// returns the weighted sum of count pixels with each channel rounded and
+// clamped to 0-255
+QRgb resamplePixel(const QRgb *pixels, const qint16 *weights, int count) {
+  const int half = 1 << (WEIGHT_PRECISION_BITS - 1);
+#ifdef __SSE2__
+  /*
+   * the channels of two neighboring pixels are interleaved into 16-bit lanes
+   * so that one multiply-add applies both of their weights to all four
+   * channels at once
+   */
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = _mm_set1_epi32(half);
+  int i = 0;
+  for (; i + 3 < count; i += 4) {
+    __m128i quad =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+    __m128i shifted = _mm_srli_si128(quad, 4);
+    __m128i firstPair =
+        _mm_unpacklo_epi8(_mm_unpacklo_epi8(quad, shifted), zero);
+    __m128i secondPair =
+        _mm_unpacklo_epi8(_mm_unpackhi_epi8(quad, shifted), zero);
+    __m128i quadWeights =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights + i));
+    sum = _mm_add_epi32(
+        sum, _mm_madd_epi16(firstPair, _mm_shuffle_epi32(quadWeights, 0x00)));
+    sum = _mm_add_epi32(
+        sum, _mm_madd_epi16(secondPair, _mm_shuffle_epi32(quadWeights, 0x55)));
+  }
+
+  for (; i + 1 < count; i += 2) {
+    __m128i first = _mm_cvtsi32_si128(static_cast<int>(pixels[i]));
+    __m128i second = _mm_cvtsi32_si128(static_cast<int>(pixels[i + 1]));
+    __m128i pair = _mm_unpacklo_epi8(_mm_unpacklo_epi8(first, second), zero);
+    __m128i pairWeights = _mm_set1_epi32(
+        static_cast<int>((static_cast<quint32>(weights[i + 1]) << 16) |
+                         static_cast<quint16>(weights[i])));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, pairWeights));
+  }
+
+  if (i < count) {
+    __m128i pixel = _mm_cvtsi32_si128(static_cast<int>(pixels[i]));
+    pixel = _mm_unpacklo_epi8(_mm_unpacklo_epi8(pixel, zero), zero);
+    __m128i weight = _mm_set1_epi32(static_cast<quint16>(weights[i]));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(pixel, weight));
+  }
+
+  sum = _mm_srai_epi32(sum, WEIGHT_PRECISION_BITS);
+  sum = _mm_packs_epi32(sum, sum);
+  sum = _mm_packus_epi16(sum, sum);
+  return static_cast<QRgb>(_mm_cvtsi128_si32(sum));
+#else
+  int red = half;
+  int green = half;
+  int blue = half;
+  int alpha = half;
+  for (int i = 0; i < count; ++i) {
+    red += qRed(pixels[i]) * weights[i];
+    green += qGreen(pixels[i]) * weights[i];
+    blue += qBlue(pixels[i]) * weights[i];
+    alpha += qAlpha(pixels[i]) * weights[i];
+  }
+
+  auto clamp = [](int value) {
+    return std::min(std::max(value >> WEIGHT_PRECISION_BITS, 0), 255);
+  };
+  return qRgba(clamp(red), clamp(green), clamp(blue), clamp(alpha));
+#endif
+}
+
+/*
+ * resamples every row of source along the row with axisWeights and writes the
+ * results transposed, so output pixel x of row y goes to
+ * destination[x * destinationStride + y]. running this twice resizes both
+ * axes while both passes read contiguous memory. rows are handled in blocks
+ * that are spread across the global thread pool.
+ */
+void resampleRowsTransposed(const QRgb *source, int sourceStride,
+                            int rowCount, const AxisWeights &axisWeights,
+                            QRgb *destination, int destinationStride) {
+  int outputLength = axisWeights.starts.size();
+  QVector<int> blocks((rowCount + ROW_BLOCK_SIZE - 1) / ROW_BLOCK_SIZE);
+  std::iota(blocks.begin(), blocks.end(), 0);
+
+  QtConcurrent::blockingMap(blocks, [&](int &block) {
+    int firstRow = block * ROW_BLOCK_SIZE;
+    int endRow = std::min(firstRow + ROW_BLOCK_SIZE, rowCount);
+    for (int x = 0; x < outputLength; ++x) {
+      const qint16 *weights =
+          axisWeights.weights.constData() + x * axisWeights.taps;
+      int start = axisWeights.starts[x];
+      int count = axisWeights.counts[x];
+      QRgb *out = destination + static_cast<qint64>(x) * destinationStride;
+      for (int y = firstRow; y < endRow; ++y) {
+        const QRgb *row = source + static_cast<qint64>(y) * sourceStride;
+        out[y] = resamplePixel(row + start, weights, count);
+      }
+    }
+  });
+}
+}  // namespace
+
+QImage resizeImage(const QImage &image, int width, int height,
+                   ResizeFilter filter) {
+  if (image.isNull() || width <= 0 || height <= 0) {
+    return QImage();
+  }
+
+  /*
+   * pixels with alpha are filtered premultiplied so that the colors of
+   * transparent pixels don't bleed into their neighbors
+   */
+  bool hasAlpha = image.hasAlphaChannel();
+  QImage source = image.convertToFormat(
+      hasAlpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+  Filter resizeFilter = getFilter(filter);
+  AxisWeights horizontalWeights =
+      computeAxisWeights(source.width(), width, resizeFilter);
+  AxisWeights verticalWeights =
+      computeAxisWeights(source.height(), height, resizeFilter);
+
+  if (horizontalWeights.taps == 0 || verticalWeights.taps == 0) {
+    return QImage();
+  }
+
+  // width columns of source.height() pixels each
+  qint64 intermediateSize = static_cast<qint64>(width) * source.height();
+  QImage resized(width, height, source.format());
+  if (intermediateSize * static_cast<qint64>(sizeof(QRgb)) > INT_MAX ||
+      resized.isNull()) {
+    return QImage();
+  }
+
+  QVector<QRgb> intermediate(static_cast<int>(intermediateSize));
+  resampleRowsTransposed(
+      reinterpret_cast<const QRgb *>(source.constBits()),
+      source.bytesPerLine() / static_cast<int>(sizeof(QRgb)), source.height(),
+      horizontalWeights, intermediate.data(), source.height());
+
+  resampleRowsTransposed(
+      intermediate.constData(), source.height(), width, verticalWeights,
+      reinterpret_cast<QRgb *>(resized.bits()),
+      resized.bytesPerLine() / static_cast<int>(sizeof(QRgb)));
+
+  if (!hasAlpha) {
+    return resized;
+  }
+
+  // negative filter lobes can push a premultiplied color above its alpha
+  for (int y = 0; y < height; ++y) {
+    QRgb *pixels = reinterpret_cast<QRgb *>(resized.scanLine(y));
+    for (int x = 0; x < width; ++x) {
+      int alpha = qAlpha(pixels[x]);
+      pixels[x] = qRgba(std::min(qRed(pixels[x]), alpha),
+                        std::min(qGreen(pixels[x]), alpha),
+                        std::min(qBlue(pixels[x]), alpha), alpha);
+    }
+  }
+
+  return resized.convertToFormat(QImage::Format_ARGB32);
+}
+}  // namespace tlo
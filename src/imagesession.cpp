@@ -0,0 +1,296 @@
+#include "tlo/imagesession.hpp"
+#include <QDataStream>
+#include <QFile>
+#include <QRect>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+#include <zlib.h>
+
+namespace tlo {
+namespace {
+const quint32 SESSION_MAGIC = 0x544C4F53;  // "TLOS"
+const quint32 SESSION_VERSION = 1;
+const int TILE_SIZE = 256;
+// tiles start on page boundaries so each can be mapped on its own
+const qint64 TILE_ALIGNMENT = 4096;
+const int BYTES_PER_PIXEL = 4;
+// one bin per value of an 8-bit channel
+const int HISTOGRAM_BIN_COUNT = 256;
+
+int computeTileCount(int width, int height, int tileSize) {
+  int columns = (width + tileSize - 1) / tileSize;
+  int rows = (height + tileSize - 1) / tileSize;
+  return columns * rows;
+}
+
+QRect computeTileRect(int width, int height, int tileSize, int tileIndex) {
+  int columns = (width + tileSize - 1) / tileSize;
+  int x = (tileIndex % columns) * tileSize;
+  int y = (tileIndex / columns) * tileSize;
+  return QRect(x, y, std::min(tileSize, width - x),
+               std::min(tileSize, height - y));
+}
+
+bool hasValidImageInformation(const ImageSession &session) {
+  if (!session.hasImageInformation) {
+    return true;
+  }
+
+  return session.redHistogram.size() == HISTOGRAM_BIN_COUNT &&
+         session.greenHistogram.size() == HISTOGRAM_BIN_COUNT &&
+         session.blueHistogram.size() == HISTOGRAM_BIN_COUNT &&
+         session.alphaHistogram.size() == HISTOGRAM_BIN_COUNT &&
+         std::isfinite(session.redEntropy) &&
+         std::isfinite(session.greenEntropy) &&
+         std::isfinite(session.blueEntropy) &&
+         std::isfinite(session.alphaEntropy);
+}
+
+// copies one tile out of image so its rows are contiguous, then compresses it
+struct TileCompressor {
+  typedef QByteArray result_type;
+
+  const QImage *image;
+
+  QByteArray operator()(int tileIndex) const {
+    QRect rect = computeTileRect(image->width(), image->height(), TILE_SIZE,
+                                 tileIndex);
+    std::size_t rowLength =
+        static_cast<std::size_t>(rect.width() * BYTES_PER_PIXEL);
+    std::vector<uchar> pixels(rowLength *
+                              static_cast<std::size_t>(rect.height()));
+    for (int row = 0; row < rect.height(); ++row) {
+      std::memcpy(pixels.data() + rowLength * static_cast<std::size_t>(row),
+                  image->constScanLine(rect.y() + row) +
+                      rect.x() * BYTES_PER_PIXEL,
+                  rowLength);
+    }
+
+    uLongf compressedLength = compressBound(static_cast<uLong>(pixels.size()));
+    QByteArray compressed(static_cast<int>(compressedLength), '\0');
+    int result =
+        compress2(reinterpret_cast<Bytef *>(compressed.data()),
+                  &compressedLength, pixels.data(),
+                  static_cast<uLong>(pixels.size()), Z_BEST_SPEED);
+    if (result != Z_OK) {
+      return QByteArray();
+    }
+
+    compressed.resize(static_cast<int>(compressedLength));
+    return compressed;
+  }
+};
+}  // namespace
+
+bool writeImageSession(const ImageSession &session, const QString &filePath) {
+  if (session.image.isNull()) {
+    return false;
+  }
+
+  bool hasAlpha = session.image.hasAlphaChannel();
+  QImage image = session.image.convertToFormat(
+      hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+  int tileCount = computeTileCount(image.width(), image.height(), TILE_SIZE);
+  QVector<int> tileIndexes(tileCount);
+  std::iota(tileIndexes.begin(), tileIndexes.end(), 0);
+  QFuture<QByteArray> compressedTiles =
+      QtConcurrent::mapped(tileIndexes, TileCompressor{&image});
+
+  QSaveFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly)) {
+    compressedTiles.waitForFinished();
+    return false;
+  }
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+  stream << SESSION_MAGIC << SESSION_VERSION << session.sourceFilePath;
+  stream << static_cast<quint32>(session.operations.size());
+  for (const auto &operation : session.operations) {
+    stream << operation.name << operation.arguments;
+  }
+
+  stream << static_cast<qint32>(image.width())
+         << static_cast<qint32>(image.height()) << hasAlpha
+         << static_cast<qint32>(TILE_SIZE);
+
+  stream << session.hasImageInformation;
+  if (session.hasImageInformation) {
+    stream << session.redHistogram << session.greenHistogram
+           << session.blueHistogram << session.alphaHistogram;
+    stream << session.redEntropy << session.greenEntropy
+           << session.blueEntropy << session.alphaEntropy;
+  }
+
+  // the tile index is written once the tile offsets are known
+  stream << static_cast<quint32>(tileCount);
+  qint64 indexOffset = file.pos();
+  for (int i = 0; i < tileCount; ++i) {
+    stream << static_cast<quint64>(0) << static_cast<quint32>(0);
+  }
+
+  QVector<quint64> tileOffsets;
+  QVector<quint32> tileSizes;
+  bool ok = true;
+  for (int i = 0; i < tileCount; ++i) {
+    QByteArray tile = compressedTiles.resultAt(i);
+    if (tile.isEmpty()) {
+      ok = false;
+      break;
+    }
+
+    qint64 padding = (TILE_ALIGNMENT - file.pos() % TILE_ALIGNMENT) %
+                     TILE_ALIGNMENT;
+    file.write(QByteArray(static_cast<int>(padding), '\0'));
+    tileOffsets << static_cast<quint64>(file.pos());
+    tileSizes << static_cast<quint32>(tile.size());
+    file.write(tile);
+  }
+
+  compressedTiles.waitForFinished();
+  if (!ok || !file.seek(indexOffset)) {
+    file.cancelWriting();
+    return false;
+  }
+
+  for (int i = 0; i < tileCount; ++i) {
+    stream << tileOffsets[i] << tileSizes[i];
+  }
+
+  if (stream.status() != QDataStream::Ok) {
+    file.cancelWriting();
+    return false;
+  }
+
+  return file.commit();
+}
+
+bool readImageSession(const QString &filePath, ImageSession &session) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+  quint32 magic;
+  quint32 version;
+  stream >> magic >> version;
+  if (magic != SESSION_MAGIC || version != SESSION_VERSION) {
+    return false;
+  }
+
+  ImageSession readSession;
+  quint32 operationCount;
+  stream >> readSession.sourceFilePath >> operationCount;
+  for (quint32 i = 0; i < operationCount && stream.status() == QDataStream::Ok;
+       ++i) {
+    ImageOperation operation;
+    stream >> operation.name >> operation.arguments;
+    readSession.operations << operation;
+  }
+
+  qint32 width;
+  qint32 height;
+  bool hasAlpha;
+  qint32 tileSize;
+  stream >> width >> height >> hasAlpha >> tileSize;
+
+  stream >> readSession.hasImageInformation;
+  if (readSession.hasImageInformation) {
+    stream >> readSession.redHistogram >> readSession.greenHistogram >>
+        readSession.blueHistogram >> readSession.alphaHistogram;
+    stream >> readSession.redEntropy >> readSession.greenEntropy >>
+        readSession.blueEntropy >> readSession.alphaEntropy;
+  }
+
+  /*
+   * the header is checked before anything is derived from it. qt5 can't
+   * allocate a QImage of more than INT_MAX bytes, the writer only ever uses
+   * TILE_SIZE and the cached histograms are trusted by the model as they
+   * are, so anything else means the file is corrupt
+   */
+  quint32 tileCount;
+  stream >> tileCount;
+  if (stream.status() != QDataStream::Ok || width <= 0 || height <= 0 ||
+      static_cast<qint64>(width) * height * BYTES_PER_PIXEL > INT_MAX ||
+      !hasValidImageInformation(readSession) ||
+      tileSize != TILE_SIZE ||
+      tileCount != static_cast<quint32>(
+                       computeTileCount(width, height, tileSize))) {
+    return false;
+  }
+
+  QVector<quint64> tileOffsets(static_cast<int>(tileCount));
+  QVector<quint32> tileSizes(static_cast<int>(tileCount));
+  for (int i = 0; i < tileOffsets.size(); ++i) {
+    stream >> tileOffsets[i] >> tileSizes[i];
+  }
+
+  if (stream.status() != QDataStream::Ok) {
+    return false;
+  }
+
+  readSession.image = QImage(
+      width, height, hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+  quint64 fileSize = static_cast<quint64>(file.size());
+  uchar *mapped = file.map(0, static_cast<qint64>(fileSize));
+  if (readSession.image.isNull() || mapped == nullptr) {
+    return false;
+  }
+
+  /*
+   * the tiles are decompressed straight out of the mapping, so only the pages
+   * of the tile being decompressed need to be read from disk at any time
+   */
+  uchar *bits = readSession.image.bits();
+  int bytesPerLine = readSession.image.bytesPerLine();
+  std::atomic<bool> ok(true);
+  QVector<int> tileIndexes(static_cast<int>(tileCount));
+  std::iota(tileIndexes.begin(), tileIndexes.end(), 0);
+  QtConcurrent::blockingMap(tileIndexes, [&](int &tileIndex) {
+    QRect rect = computeTileRect(width, height, tileSize, tileIndex);
+    quint64 offset = tileOffsets[tileIndex];
+    quint32 compressedSize = tileSizes[tileIndex];
+    // written so that a huge offset can't wrap around and pass the check
+    if (offset > fileSize || compressedSize > fileSize - offset) {
+      ok = false;
+      return;
+    }
+
+    std::size_t rowLength =
+        static_cast<std::size_t>(rect.width() * BYTES_PER_PIXEL);
+    std::vector<uchar> pixels(rowLength *
+                              static_cast<std::size_t>(rect.height()));
+    uLongf length = static_cast<uLongf>(pixels.size());
+    int result = uncompress(pixels.data(), &length, mapped + offset,
+                            static_cast<uLong>(compressedSize));
+    if (result != Z_OK || length != pixels.size()) {
+      ok = false;
+      return;
+    }
+
+    for (int row = 0; row < rect.height(); ++row) {
+      std::memcpy(bits + static_cast<qint64>(rect.y() + row) * bytesPerLine +
+                      rect.x() * BYTES_PER_PIXEL,
+                  pixels.data() + rowLength * static_cast<std::size_t>(row),
+                  rowLength);
+    }
+  });
+
+  file.unmap(mapped);
+  if (!ok) {
+    return false;
+  }
+
+  session = readSession;
+  return true;
+}
+}  // namespace tlo
@@ -0,0 +1,572 @@
+#include "tlo/imagewriter.hpp"
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+#include <zlib.h>
+
+namespace tlo {
+namespace {
+// aim for chunks of about this many uncompressed bytes when automatic
+const qint64 AUTOMATIC_CHUNK_BYTES = 1 << 20;
+// keeps zlib's 32-bit lengths and QByteArray's int sizes from overflowing
+const qint64 MAX_CHUNK_BYTES = 1 << 28;
+const int MAX_PNG_CHUNK_LENGTH = 1 << 30;
+
+struct CompressedChunk {
+  bool ok = false;
+  QByteArray data;
+  uLong adler = 0;
+  qint64 inputLength = 0;
+};
+
+int computeRowsPerChunk(const QImage &image, int bytesPerPixel,
+                        const ImageWriteOptions &options) {
+  qint64 rowBytes = static_cast<qint64>(image.width()) * bytesPerPixel + 1;
+  qint64 maxRows = std::max<qint64>(1, MAX_CHUNK_BYTES / rowBytes);
+  qint64 rows = options.rowsPerChunk > 0
+                    ? options.rowsPerChunk
+                    : std::max<qint64>(1, AUTOMATIC_CHUNK_BYTES / rowBytes);
+  return static_cast<int>(std::min(rows, maxRows));
+}
+
+int computeChunkCount(int height, int rowsPerChunk) {
+  return (height + rowsPerChunk - 1) / rowsPerChunk;
+}
+
+// writes row y of a 32-bit image as 8-bit samples in RGB or RGBA order
+void unpackRow(const QImage &image, int y, bool hasAlpha, uchar *out) {
+  const QRgb *pixels = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+  for (int x = 0; x < image.width(); ++x) {
+    *out++ = static_cast<uchar>(qRed(pixels[x]));
+    *out++ = static_cast<uchar>(qGreen(pixels[x]));
+    *out++ = static_cast<uchar>(qBlue(pixels[x]));
+    if (hasAlpha) {
+      *out++ = static_cast<uchar>(qAlpha(pixels[x]));
+    }
+  }
+}
+
+/*
+ * compresses input into a deflate stream. when last is false, the stream is
+ * ended with a sync flush instead of a final block so that the compressed
+ * chunks of one image can be concatenated into a single valid stream.
+ */
+CompressedChunk deflateChunk(const std::vector<uchar> &input, int level,
+                             bool raw, bool last) {
+  CompressedChunk chunk;
+  chunk.inputLength = static_cast<qint64>(input.size());
+  chunk.adler = adler32(adler32(0L, Z_NULL, 0), input.data(),
+                        static_cast<uInt>(input.size()));
+
+  z_stream stream = z_stream();
+  int windowBits = raw ? -MAX_WBITS : MAX_WBITS;
+  if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return chunk;
+  }
+
+  chunk.data.resize(static_cast<int>(
+      deflateBound(&stream, static_cast<uLong>(input.size())) + 16));
+  stream.next_in = const_cast<Bytef *>(input.data());
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef *>(chunk.data.data());
+  stream.avail_out = static_cast<uInt>(chunk.data.size());
+
+  int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+  for (;;) {
+    int result = deflate(&stream, flush);
+    if (result == Z_STREAM_ERROR) {
+      break;
+    }
+
+    if (last ? result == Z_STREAM_END : stream.avail_out != 0) {
+      chunk.ok = true;
+      break;
+    }
+
+    if (stream.avail_out != 0) {
+      break;
+    }
+
+    int used = chunk.data.size();
+    chunk.data.resize(used * 2);
+    stream.next_out = reinterpret_cast<Bytef *>(chunk.data.data() + used);
+    stream.avail_out = static_cast<uInt>(used);
+  }
+
+  chunk.data.resize(static_cast<int>(stream.total_out));
+  deflateEnd(&stream);
+  return chunk;
+}
+
+void appendUint16LittleEndian(QByteArray &bytes, quint32 value) {
+  bytes.append(static_cast<char>(value & 0xFF));
+  bytes.append(static_cast<char>((value >> 8) & 0xFF));
+}
+
+void appendUint32LittleEndian(QByteArray &bytes, quint32 value) {
+  appendUint16LittleEndian(bytes, value & 0xFFFF);
+  appendUint16LittleEndian(bytes, value >> 16);
+}
+
+void appendUint32BigEndian(QByteArray &bytes, quint32 value) {
+  bytes.append(static_cast<char>((value >> 24) & 0xFF));
+  bytes.append(static_cast<char>((value >> 16) & 0xFF));
+  bytes.append(static_cast<char>((value >> 8) & 0xFF));
+  bytes.append(static_cast<char>(value & 0xFF));
+}
+
+uchar paethPredictor(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = std::abs(p - a);
+  int pb = std::abs(p - b);
+  int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return static_cast<uchar>(a);
+  }
+  if (pb <= pc) {
+    return static_cast<uchar>(b);
+  }
+  return static_cast<uchar>(c);
+}
+
+const int PNG_FILTER_COUNT = 5;
+
+/*
+ * appends the filter type byte and the filtered row to out. all five png
+ * filters are tried and the one with the smallest sum of absolute values is
+ * kept, which is the same heuristic libpng uses.
+ */
+void filterPngRow(const std::vector<uchar> &row,
+                  const std::vector<uchar> &previousRow, int bytesPerPixel,
+                  std::vector<uchar> (&candidates)[PNG_FILTER_COUNT],
+                  std::vector<uchar> &out) {
+  long sums[PNG_FILTER_COUNT] = {0, 0, 0, 0, 0};
+  for (std::size_t i = 0; i < row.size(); ++i) {
+    bool hasLeft = i >= static_cast<std::size_t>(bytesPerPixel);
+    int x = row[i];
+    int a = hasLeft ? row[i - static_cast<std::size_t>(bytesPerPixel)] : 0;
+    int b = previousRow[i];
+    int c = hasLeft ? previousRow[i - static_cast<std::size_t>(bytesPerPixel)]
+                    : 0;
+    uchar filtered[PNG_FILTER_COUNT] = {
+        static_cast<uchar>(x), static_cast<uchar>(x - a),
+        static_cast<uchar>(x - b), static_cast<uchar>(x - (a + b) / 2),
+        static_cast<uchar>(x - paethPredictor(a, b, c))};
+    for (int filter = 0; filter < PNG_FILTER_COUNT; ++filter) {
+      candidates[filter][i] = filtered[filter];
+      sums[filter] += std::abs(static_cast<signed char>(filtered[filter]));
+    }
+  }
+
+  int bestFilter = 0;
+  for (int filter = 1; filter < PNG_FILTER_COUNT; ++filter) {
+    if (sums[filter] < sums[bestFilter]) {
+      bestFilter = filter;
+    }
+  }
+
+  out.push_back(static_cast<uchar>(bestFilter));
+  out.insert(out.end(), candidates[bestFilter].begin(),
+             candidates[bestFilter].end());
+}
+
+/*
+ * filters and compresses one chunk of rows. filtering only looks at the
+ * unfiltered previous row, which is read straight from the image, so every
+ * chunk can be handled independently of the others.
+ */
+struct PngChunkCompressor {
+  typedef CompressedChunk result_type;
+
+  const QImage *image;
+  bool hasAlpha;
+  int rowsPerChunk;
+  int chunkCount;
+  int compressionLevel;
+
+  CompressedChunk operator()(int chunkIndex) const {
+    int bytesPerPixel = hasAlpha ? 4 : 3;
+    std::size_t rowLength =
+        static_cast<std::size_t>(image->width() * bytesPerPixel);
+    int firstRow = chunkIndex * rowsPerChunk;
+    int endRow = std::min(firstRow + rowsPerChunk, image->height());
+
+    std::vector<uchar> previousRow(rowLength, 0);
+    std::vector<uchar> row(rowLength, 0);
+    std::vector<uchar> candidates[PNG_FILTER_COUNT];
+    for (auto &candidate : candidates) {
+      candidate.resize(rowLength);
+    }
+
+    if (firstRow > 0) {
+      unpackRow(*image, firstRow - 1, hasAlpha, previousRow.data());
+    }
+
+    std::vector<uchar> filtered;
+    filtered.reserve((rowLength + 1) *
+                     static_cast<std::size_t>(endRow - firstRow));
+    for (int y = firstRow; y < endRow; ++y) {
+      unpackRow(*image, y, hasAlpha, row.data());
+      filterPngRow(row, previousRow, bytesPerPixel, candidates, filtered);
+      row.swap(previousRow);
+    }
+
+    bool last = chunkIndex == chunkCount - 1;
+    return deflateChunk(filtered, compressionLevel, true, last);
+  }
+};
+
+/*
+ * compresses one strip with horizontal differencing (tiff predictor 2). each
+ * strip is a complete zlib stream as required by tiff's deflate compression.
+ */
+struct TiffStripCompressor {
+  typedef CompressedChunk result_type;
+
+  const QImage *image;
+  bool hasAlpha;
+  int rowsPerStrip;
+  int compressionLevel;
+
+  CompressedChunk operator()(int stripIndex) const {
+    int bytesPerPixel = hasAlpha ? 4 : 3;
+    std::size_t rowLength =
+        static_cast<std::size_t>(image->width() * bytesPerPixel);
+    int firstRow = stripIndex * rowsPerStrip;
+    int endRow = std::min(firstRow + rowsPerStrip, image->height());
+
+    std::vector<uchar> samples(rowLength *
+                               static_cast<std::size_t>(endRow - firstRow));
+    for (int y = firstRow; y < endRow; ++y) {
+      uchar *row =
+          samples.data() + rowLength * static_cast<std::size_t>(y - firstRow);
+      unpackRow(*image, y, hasAlpha, row);
+      for (std::size_t i = rowLength - 1;
+           i >= static_cast<std::size_t>(bytesPerPixel); --i) {
+        row[i] = static_cast<uchar>(
+            row[i] - row[i - static_cast<std::size_t>(bytesPerPixel)]);
+      }
+    }
+
+    return deflateChunk(samples, compressionLevel, false, true);
+  }
+};
+
+void reportPercentage(const std::function<void(int)> &reportProgress,
+                      int done, int total) {
+  if (reportProgress) {
+    reportProgress(static_cast<int>(static_cast<qint64>(done) * 100 / total));
+  }
+}
+
+void writePngChunk(QIODevice &device, const char *type,
+                   const QByteArray &data) {
+  QByteArray header;
+  appendUint32BigEndian(header, static_cast<quint32>(data.size()));
+  header.append(type, 4);
+
+  uLong crc = crc32(0L, Z_NULL, 0);
+  crc = crc32(crc, reinterpret_cast<const Bytef *>(type), 4);
+  crc = crc32(crc, reinterpret_cast<const Bytef *>(data.constData()),
+              static_cast<uInt>(data.size()));
+  QByteArray footer;
+  appendUint32BigEndian(footer, static_cast<quint32>(crc));
+
+  device.write(header);
+  device.write(data);
+  device.write(footer);
+}
+
+QByteArray zlibHeader(int compressionLevel) {
+  int cmf = 0x78;  // deflate with a 32K window
+  int flevel = 2;
+  if (compressionLevel >= 0 && compressionLevel <= 1) {
+    flevel = 0;
+  } else if (compressionLevel >= 2 && compressionLevel <= 5) {
+    flevel = 1;
+  } else if (compressionLevel >= 7) {
+    flevel = 3;
+  }
+
+  int flg = flevel << 6;
+  flg += (31 - (cmf * 256 + flg) % 31) % 31;
+  QByteArray header;
+  header.append(static_cast<char>(cmf));
+  header.append(static_cast<char>(flg));
+  return header;
+}
+
+bool writePng(const QImage &image, QSaveFile &file,
+              const ImageWriteOptions &options,
+              const std::function<void(int)> &reportProgress) {
+  bool hasAlpha = image.hasAlphaChannel();
+  int rowsPerChunk = computeRowsPerChunk(image, hasAlpha ? 4 : 3, options);
+  int chunkCount = computeChunkCount(image.height(), rowsPerChunk);
+  int compressionLevel =
+      options.compressionLevel < 0 ? Z_DEFAULT_COMPRESSION
+                                   : std::min(options.compressionLevel, 9);
+
+  QVector<int> chunkIndexes(chunkCount);
+  std::iota(chunkIndexes.begin(), chunkIndexes.end(), 0);
+  QFuture<CompressedChunk> compressedChunks = QtConcurrent::mapped(
+      chunkIndexes, PngChunkCompressor{&image, hasAlpha, rowsPerChunk,
+                                       chunkCount, compressionLevel});
+
+  file.write("\x89PNG\r\n\x1A\n", 8);
+
+  QByteArray header;
+  appendUint32BigEndian(header, static_cast<quint32>(image.width()));
+  appendUint32BigEndian(header, static_cast<quint32>(image.height()));
+  header.append(static_cast<char>(8));               // bit depth
+  header.append(static_cast<char>(hasAlpha ? 6 : 2));  // color type
+  header.append(static_cast<char>(0));               // compression method
+  header.append(static_cast<char>(0));               // filter method
+  header.append(static_cast<char>(0));               // interlace method
+  writePngChunk(file, "IHDR", header);
+
+  if (image.dotsPerMeterX() > 0 && image.dotsPerMeterY() > 0) {
+    QByteArray physicalDimensions;
+    appendUint32BigEndian(physicalDimensions,
+                          static_cast<quint32>(image.dotsPerMeterX()));
+    appendUint32BigEndian(physicalDimensions,
+                          static_cast<quint32>(image.dotsPerMeterY()));
+    physicalDimensions.append(static_cast<char>(1));  // unit is the meter
+    writePngChunk(file, "pHYs", physicalDimensions);
+  }
+
+  /*
+   * the chunks are written in order as they become ready. their deflate data
+   * is concatenated into one zlib stream whose adler-32 checksum is combined
+   * from the checksums of the chunks.
+   */
+  QByteArray imageData = zlibHeader(compressionLevel);
+  uLong adler = adler32(0L, Z_NULL, 0);
+  bool ok = true;
+  for (int i = 0; i < chunkCount; ++i) {
+    CompressedChunk chunk = compressedChunks.resultAt(i);
+    if (!chunk.ok) {
+      ok = false;
+      break;
+    }
+
+    adler = adler32_combine(adler, chunk.adler,
+                            static_cast<z_off_t>(chunk.inputLength));
+    imageData.append(chunk.data);
+    if (i == chunkCount - 1) {
+      appendUint32BigEndian(imageData, static_cast<quint32>(adler));
+    }
+
+    for (int offset = 0; offset < imageData.size();
+         offset += MAX_PNG_CHUNK_LENGTH) {
+      writePngChunk(file, "IDAT", imageData.mid(offset, MAX_PNG_CHUNK_LENGTH));
+    }
+    imageData.clear();
+    reportPercentage(reportProgress, i + 1, chunkCount);
+  }
+
+  compressedChunks.waitForFinished();
+  if (!ok) {
+    return false;
+  }
+
+  writePngChunk(file, "IEND", QByteArray());
+  return true;
+}
+
+const quint32 TIFF_SHORT = 3;
+const quint32 TIFF_LONG = 4;
+const quint32 TIFF_RATIONAL = 5;
+
+void appendIfdEntry(QByteArray &ifd, quint32 tag, quint32 type, quint32 count,
+                    quint32 value) {
+  appendUint16LittleEndian(ifd, tag);
+  appendUint16LittleEndian(ifd, type);
+  appendUint32LittleEndian(ifd, count);
+  appendUint32LittleEndian(ifd, value);
+}
+
+bool writeTiff(const QImage &image, QSaveFile &file,
+               const ImageWriteOptions &options,
+               const std::function<void(int)> &reportProgress) {
+  bool hasAlpha = image.hasAlphaChannel();
+  quint32 samplesPerPixel = hasAlpha ? 4 : 3;
+  int rowsPerStrip = computeRowsPerChunk(image, hasAlpha ? 4 : 3, options);
+  int stripCount = computeChunkCount(image.height(), rowsPerStrip);
+  int compressionLevel =
+      options.compressionLevel < 0 ? Z_DEFAULT_COMPRESSION
+                                   : std::min(options.compressionLevel, 9);
+
+  QVector<int> stripIndexes(stripCount);
+  std::iota(stripIndexes.begin(), stripIndexes.end(), 0);
+  QFuture<CompressedChunk> compressedStrips = QtConcurrent::mapped(
+      stripIndexes,
+      TiffStripCompressor{&image, hasAlpha, rowsPerStrip, compressionLevel});
+
+  // little-endian header. the ifd offset is patched in once it is known
+  QByteArray header("II", 2);
+  appendUint16LittleEndian(header, 42);
+  appendUint32LittleEndian(header, 0);
+  file.write(header);
+
+  QVector<quint32> stripOffsets;
+  QVector<quint32> stripByteCounts;
+  bool ok = true;
+  for (int i = 0; i < stripCount; ++i) {
+    CompressedChunk strip = compressedStrips.resultAt(i);
+    qint64 offset = file.pos();
+    if (!strip.ok || offset + strip.data.size() > 0xFFFFFFFFLL) {
+      ok = false;
+      break;
+    }
+
+    stripOffsets << static_cast<quint32>(offset);
+    stripByteCounts << static_cast<quint32>(strip.data.size());
+    file.write(strip.data);
+    reportPercentage(reportProgress, i + 1, stripCount);
+  }
+
+  compressedStrips.waitForFinished();
+  if (!ok) {
+    return false;
+  }
+
+  // values too large for their ifd entries go between the strips and the ifd
+  qint64 valuesOffset = file.pos() + (file.pos() % 2);
+  QByteArray values;
+  if (file.pos() % 2 != 0) {
+    file.write("\0", 1);
+  }
+
+  quint32 bitsPerSampleOffset =
+      static_cast<quint32>(valuesOffset + values.size());
+  for (quint32 i = 0; i < samplesPerPixel; ++i) {
+    appendUint16LittleEndian(values, 8);
+  }
+
+  quint32 resolutionUnit = 3;  // centimeter
+  quint32 xResolution = static_cast<quint32>(image.dotsPerMeterX());
+  quint32 yResolution = static_cast<quint32>(image.dotsPerMeterY());
+  quint32 resolutionDenominator = 100;
+  if (image.dotsPerMeterX() <= 0 || image.dotsPerMeterY() <= 0) {
+    resolutionUnit = 2;  // inch
+    xResolution = 72;
+    yResolution = 72;
+    resolutionDenominator = 1;
+  }
+
+  quint32 xResolutionOffset =
+      static_cast<quint32>(valuesOffset + values.size());
+  appendUint32LittleEndian(values, xResolution);
+  appendUint32LittleEndian(values, resolutionDenominator);
+  quint32 yResolutionOffset =
+      static_cast<quint32>(valuesOffset + values.size());
+  appendUint32LittleEndian(values, yResolution);
+  appendUint32LittleEndian(values, resolutionDenominator);
+
+  quint32 stripOffsetsValue = stripOffsets.value(0);
+  quint32 stripByteCountsValue = stripByteCounts.value(0);
+  if (stripCount > 1) {
+    stripOffsetsValue = static_cast<quint32>(valuesOffset + values.size());
+    for (quint32 stripOffset : stripOffsets) {
+      appendUint32LittleEndian(values, stripOffset);
+    }
+
+    stripByteCountsValue = static_cast<quint32>(valuesOffset + values.size());
+    for (quint32 stripByteCount : stripByteCounts) {
+      appendUint32LittleEndian(values, stripByteCount);
+    }
+  }
+
+  qint64 ifdOffset = valuesOffset + values.size();
+  if (ifdOffset > 0xFFFFFFFFLL) {
+    return false;
+  }
+
+  // entries must be sorted by tag
+  QByteArray ifd;
+  quint32 stripCountValue = static_cast<quint32>(stripCount);
+  appendUint16LittleEndian(ifd, hasAlpha ? 15 : 14);
+  appendIfdEntry(ifd, 256, TIFF_LONG, 1, static_cast<quint32>(image.width()));
+  appendIfdEntry(ifd, 257, TIFF_LONG, 1, static_cast<quint32>(image.height()));
+  appendIfdEntry(ifd, 258, TIFF_SHORT, samplesPerPixel, bitsPerSampleOffset);
+  appendIfdEntry(ifd, 259, TIFF_SHORT, 1, 8);  // adobe deflate
+  appendIfdEntry(ifd, 262, TIFF_SHORT, 1, 2);  // rgb
+  appendIfdEntry(ifd, 273, TIFF_LONG, stripCountValue, stripOffsetsValue);
+  appendIfdEntry(ifd, 277, TIFF_SHORT, 1, samplesPerPixel);
+  appendIfdEntry(ifd, 278, TIFF_LONG, 1, static_cast<quint32>(rowsPerStrip));
+  appendIfdEntry(ifd, 279, TIFF_LONG, stripCountValue, stripByteCountsValue);
+  appendIfdEntry(ifd, 282, TIFF_RATIONAL, 1, xResolutionOffset);
+  appendIfdEntry(ifd, 283, TIFF_RATIONAL, 1, yResolutionOffset);
+  appendIfdEntry(ifd, 284, TIFF_SHORT, 1, 1);  // chunky
+  appendIfdEntry(ifd, 296, TIFF_SHORT, 1, resolutionUnit);
+  appendIfdEntry(ifd, 317, TIFF_SHORT, 1, 2);  // horizontal differencing
+  if (hasAlpha) {
+    appendIfdEntry(ifd, 338, TIFF_SHORT, 1, 2);  // unassociated alpha
+  }
+  appendUint32LittleEndian(ifd, 0);  // no next ifd
+
+  file.write(values);
+  file.write(ifd);
+
+  QByteArray patchedIfdOffset;
+  appendUint32LittleEndian(patchedIfdOffset, static_cast<quint32>(ifdOffset));
+  return file.seek(4) && file.write(patchedIfdOffset) == 4;
+}
+}  // namespace
+
+bool writeImage(const QImage &image, const QString &filePath,
+                const ImageWriteOptions &options,
+                const std::function<void(int)> &reportProgress) {
+  if (image.isNull()) {
+    return false;
+  }
+
+  QString suffix = QFileInfo(filePath).suffix().toLower();
+  bool isPng = suffix == "png";
+  bool isTiff = suffix == "tif" || suffix == "tiff";
+  reportPercentage(reportProgress, 0, 1);
+
+  if (!isPng && !isTiff) {
+    QImageWriter writer(filePath);
+    if (options.quality >= 0) {
+      writer.setQuality(options.quality);
+    }
+    if (options.compressionLevel >= 0) {
+      writer.setCompression(options.compressionLevel);
+    }
+
+    bool written = writer.write(image);
+    reportPercentage(reportProgress, 1, 1);
+    return written;
+  }
+
+  QImage converted = image.convertToFormat(image.hasAlphaChannel()
+                                               ? QImage::Format_ARGB32
+                                               : QImage::Format_RGB32);
+
+  /*
+   * QSaveFile writes to a temporary file and only replaces filePath on
+   * commit, so a failed or partial save never clobbers an existing file
+   */
+  QSaveFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  bool written = isPng ? writePng(converted, file, options, reportProgress)
+                       : writeTiff(converted, file, options, reportProgress);
+  if (!written) {
+    file.cancelWriting();
+    return false;
+  }
+
+  return file.commit();
+}
+}  // namespace tlo
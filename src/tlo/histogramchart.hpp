@@ -0,0 +1,28 @@
+#ifndef TLO_HISTOGRAMCHART_HPP
+#define TLO_HISTOGRAMCHART_HPP
+
+#include <QVector>
+#include <QWidget>
+
+namespace tlo {
+class HistogramChart : public QWidget {
+  Q_OBJECT
+
+ private:
+  QVector<int> redHistogram;
+  QVector<int> greenHistogram;
+  QVector<int> blueHistogram;
+  QVector<int> alphaHistogram;
+
+ protected:
+  void paintEvent(QPaintEvent *event) override;
+
+ public:
+  explicit HistogramChart(QWidget *parent = nullptr);
+  void setHistograms(const QVector<int> &red, const QVector<int> &green,
+                     const QVector<int> &blue, const QVector<int> &alpha);
+  QSize sizeHint() const override;
+};
+}  // namespace tlo
+
+#endif  // TLO_HISTOGRAMCHART_HPP
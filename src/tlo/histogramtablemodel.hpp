@@ -0,0 +1,44 @@
+#ifndef TLO_HISTOGRAMTABLEMODEL_HPP
+#define TLO_HISTOGRAMTABLEMODEL_HPP
+
+#include <QAbstractTableModel>
+#include <QVector>
+
+namespace tlo {
+/*
+ * exposes one row per histogram bin with the bin's count in each channel.
+ * counts are read from the histograms on demand, so views only ever touch the
+ * rows they show.
+ */
+class HistogramTableModel : public QAbstractTableModel {
+  Q_OBJECT
+
+ private:
+  QVector<int> redHistogram;
+  QVector<int> greenHistogram;
+  QVector<int> blueHistogram;
+  QVector<int> alphaHistogram;
+
+ public:
+  enum Column {
+    VALUE_COLUMN,
+    RED_COLUMN,
+    GREEN_COLUMN,
+    BLUE_COLUMN,
+    ALPHA_COLUMN,
+    COLUMN_COUNT
+  };
+
+  explicit HistogramTableModel(QObject *parent = nullptr);
+  void setHistograms(const QVector<int> &red, const QVector<int> &green,
+                     const QVector<int> &blue, const QVector<int> &alpha);
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+};
+}  // namespace tlo
+
+#endif  // TLO_HISTOGRAMTABLEMODEL_HPP
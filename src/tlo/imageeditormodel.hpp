@@ -1,9 +1,13 @@
 #ifndef TLO_IMAGEEDITORMODEL_HPP
 #define TLO_IMAGEEDITORMODEL_HPP
 
+#include <QFutureWatcher>
 #include <QImage>
-#include <QMap>
 #include <QObject>
+#include <QVector>
+#include "imageresizer.hpp"
+#include "imagesession.hpp"
+#include "imagewriter.hpp"
 
 namespace tlo {
 class ImageEditorModel : public QObject {
@@ -11,30 +15,46 @@ class ImageEditorModel : public QObject {
 
  private:
   QString filePath_;
-  QImage originalImage_;
+  // loaded lazily after a session is loaded
+  mutable QImage originalImage_;
   QImage image_;
+  QVector<ImageOperation> operations_;
 
   int revision = 0;
   int computedInfoRevision = -1;
-  QMap<int, int> redHistogram_;
-  QMap<int, int> greenHistogram_;
-  QMap<int, int> blueHistogram_;
-  QMap<int, int> alphaHistogram_;
+  QVector<int> redHistogram_;
+  QVector<int> greenHistogram_;
+  QVector<int> blueHistogram_;
+  QVector<int> alphaHistogram_;
   double redEntropy_;
   double greenEntropy_;
   double blueEntropy_;
   double alphaEntropy_;
 
+  QFutureWatcher<bool> saveWatcher;
+
   void emitImageModified();
+  void logOperation(const QString &name,
+                    const QVariantList &arguments = QVariantList());
+  void loadOriginalImageIfNeeded() const;
   void copyConvertedOriginalToImage();
 
+ private slots:
+  void emitSaveFinished();
+
  public:
   explicit ImageEditorModel(QObject *parent = nullptr);
+  ~ImageEditorModel();
   bool load(const QString &filePath);
+  bool loadSession(const QString &filePath);
+  bool saveSession(const QString &filePath) const;
   bool save(const QString &filePath) const;
+  bool saveAsync(const QString &filePath, const ImageWriteOptions &options);
+  bool isSaving() const;
   const QString &filePath() const;
   const QImage &originalImage() const;
   const QImage &image() const;
+  const QVector<ImageOperation> &operations() const;
   void revertToOriginal();
   void convertToGrayscaleLightness();
   void convertToGrayscaleAverage();
@@ -48,12 +68,13 @@ class ImageEditorModel : public QObject {
                                int alphaDepth);
   void reduceColorDepthDynamic(int redDepth, int greenDepth, int blueDepth,
                                int alphaDepth);
+  bool resize(int width, int height, ResizeFilter filter);
 
   void computeImageInformation();
-  const QMap<int, int> &redHistogram();
-  const QMap<int, int> &greenHistogram();
-  const QMap<int, int> &blueHistogram();
-  const QMap<int, int> &alphaHistogram();
+  const QVector<int> &redHistogram();
+  const QVector<int> &greenHistogram();
+  const QVector<int> &blueHistogram();
+  const QVector<int> &alphaHistogram();
   double redEntropy();
   double greenEntropy();
   double blueEntropy();
@@ -61,6 +82,8 @@ class ImageEditorModel : public QObject {
 
  signals:
   void imageModified();
+  void saveProgressChanged(int percent);
+  void saveFinished(bool saved);
 };
 }  // namespace tlo
 
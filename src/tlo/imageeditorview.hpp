@@ -3,7 +3,9 @@
 
 #include <QGraphicsScene>
 #include <QMainWindow>
+#include <QProgressBar>
 #include "imageeditormodel.hpp"
+#include "imageinformationpanel.hpp"
 
 namespace tlo {
 namespace Ui {
@@ -17,11 +19,17 @@ class ImageEditorView : public QMainWindow {
   Ui::ImageEditorView *ui;
   ImageEditorModel *imageEditorModel;
   QGraphicsScene graphicsScene;
+  QProgressBar *saveProgressBar;
+  ImageInformationPanel *imageInformationPanel;
 
  private slots:
   void updateGraphicsScene();
+  void updateSaveProgress(int percent);
+  void finishSaving(bool saved);
   void on_actionOpen_triggered();
   void on_actionSave_As_triggered();
+  void on_actionOpen_Session_triggered();
+  void on_actionSave_Session_As_triggered();
   void on_actionQuit_triggered();
   void on_actionRevert_to_Original_triggered();
   void on_actionGrayscale_Lightness_triggered();
@@ -32,6 +40,7 @@ class ImageEditorView : public QMainWindow {
   void on_actionReduce_Color_Depth_Lowest_triggered();
   void on_actionReduce_Color_Depth_Highest_triggered();
   void on_actionReduce_Color_Depth_Dynamic_triggered();
+  void on_actionResize_triggered();
   void on_actionCompute_Image_Information_triggered();
 
  public:
@@ -0,0 +1,37 @@
+#ifndef TLO_IMAGEINFORMATIONPANEL_HPP
+#define TLO_IMAGEINFORMATIONPANEL_HPP
+
+#include <QDockWidget>
+#include <QLabel>
+#include "histogramchart.hpp"
+#include "histogramtablemodel.hpp"
+#include "imageeditormodel.hpp"
+
+namespace tlo {
+/*
+ * shows the histograms and entropies of the model's image. the information is
+ * only recomputed while the panel is visible and the table is updated in
+ * place rather than rebuilt.
+ */
+class ImageInformationPanel : public QDockWidget {
+  Q_OBJECT
+
+ private:
+  ImageEditorModel *imageEditorModel;
+  HistogramChart *histogramChart;
+  HistogramTableModel *histogramTableModel;
+  QLabel *entropyLabel;
+  bool outOfDate = true;
+
+ private slots:
+  void markOutOfDate();
+  void updateIfVisible();
+
+ public:
+  explicit ImageInformationPanel(ImageEditorModel &model,
+                                 QWidget *parent = nullptr);
+  void updateInformation();
+};
+}  // namespace tlo
+
+#endif  // TLO_IMAGEINFORMATIONPANEL_HPP
@@ -0,0 +1,17 @@
+#ifndef TLO_IMAGERESIZER_HPP
+#define TLO_IMAGERESIZER_HPP
+
+#include <QImage>
+
+namespace tlo {
+enum class ResizeFilter { BOX, BILINEAR, BICUBIC, LANCZOS };
+
+/*
+ * resamples image to width by height pixels with filter. the result is in
+ * Format_ARGB32 if image has an alpha channel and Format_RGB32 otherwise.
+ */
+QImage resizeImage(const QImage &image, int width, int height,
+                   ResizeFilter filter);
+}  // namespace tlo
+
+#endif  // TLO_IMAGERESIZER_HPP
@@ -0,0 +1,42 @@
+#ifndef TLO_IMAGESESSION_HPP
+#define TLO_IMAGESESSION_HPP
+
+#include <QImage>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+
+namespace tlo {
+struct ImageOperation {
+  QString name;
+  QVariantList arguments;
+};
+
+struct ImageSession {
+  QString sourceFilePath;
+  QVector<ImageOperation> operations;
+  QImage image;
+
+  bool hasImageInformation = false;
+  QVector<int> redHistogram;
+  QVector<int> greenHistogram;
+  QVector<int> blueHistogram;
+  QVector<int> alphaHistogram;
+  double redEntropy = 0;
+  double greenEntropy = 0;
+  double blueEntropy = 0;
+  double alphaEntropy = 0;
+};
+
+/*
+ * a session file starts with a header holding everything but the pixels,
+ * followed by an index of tiles. the image is split into square tiles that
+ * are each compressed on their own and stored at page aligned offsets, so the
+ * file can be memory mapped and its tiles decompressed in parallel straight
+ * from the mapping.
+ */
+bool writeImageSession(const ImageSession &session, const QString &filePath);
+bool readImageSession(const QString &filePath, ImageSession &session);
+}  // namespace tlo
+
+#endif  // TLO_IMAGESESSION_HPP
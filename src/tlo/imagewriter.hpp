@@ -0,0 +1,30 @@
+#ifndef TLO_IMAGEWRITER_HPP
+#define TLO_IMAGEWRITER_HPP
+
+#include <QImage>
+#include <QString>
+#include <functional>
+
+namespace tlo {
+struct ImageWriteOptions {
+  // encoder quality from 0 to 100 for lossy formats, -1 for the default
+  int quality = -1;
+  // zlib compression level from 0 to 9, -1 for the default
+  int compressionLevel = -1;
+  // rows per independently compressed png chunk or tiff strip, 0 for automatic
+  int rowsPerChunk = 0;
+};
+
+/*
+ * writes image to filePath. the format is chosen from the file suffix. png and
+ * tiff files are written by splitting the image into chunks of rows which are
+ * compressed in parallel. other formats are written by QImageWriter.
+ * reportProgress, if set, is called with a percentage from 0 to 100 from the
+ * calling thread.
+ */
+bool writeImage(const QImage &image, const QString &filePath,
+                const ImageWriteOptions &options,
+                const std::function<void(int)> &reportProgress = nullptr);
+}  // namespace tlo
+
+#endif  // TLO_IMAGEWRITER_HPP